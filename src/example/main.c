@@ -7,12 +7,17 @@
 #include <swamp-runtime/log.h>
 #include <swamp-runtime/print.h>
 #include <swamp-runtime/swamp.h>
+#include <swamp-unpack/crc32c.h>
 #include <swamp-unpack/swamp_unpack.h>
+#include <swamp-unpack/xxh64.h>
 
 #include <getopt.h>
 
 clog_config g_clog;
 
+// example/test.swamp-pack, embedded by swamp_unpack_embed_pack() in CMakeLists.txt
+SWAMP_UNPACK_DECLARE_EMBEDDED_PACK(swamp_unpack_example_pack);
+
 static void tyran_log_implementation(enum clog_type type, const char* string)
 {
     (void) type;
@@ -22,6 +27,12 @@ static void tyran_log_implementation(enum clog_type type, const char* string)
 typedef struct options {
     int is_verbose;
     int is_list;
+    int is_check;
+    int is_freeze;
+    int is_embedded;
+    int is_unverified;
+    swamp_unpack_profile_entry hot_functions[16];
+    size_t hot_function_count;
     const char* pack_filename;
 } options;
 
@@ -30,7 +41,12 @@ static void parse(options* flags, int argc, char* argv[])
     int opt;
     flags->is_verbose = 0;
     flags->is_list = 0;
-    while ((opt = getopt(argc, argv, "vl")) != -1) {
+    flags->is_check = 0;
+    flags->is_freeze = 0;
+    flags->is_embedded = 0;
+    flags->is_unverified = 0;
+    flags->hot_function_count = 0;
+    while ((opt = getopt(argc, argv, "vlcefup:")) != -1) {
         switch (opt) {
             case 'v':
                 flags->is_verbose = 1;
@@ -38,8 +54,30 @@ static void parse(options* flags, int argc, char* argv[])
             case 'l':
                 flags->is_list = 1;
                 break;
+            case 'c':
+                flags->is_check = 1;
+                break;
+            case 'e':
+                flags->is_embedded = 1;
+                break;
+            case 'f':
+                flags->is_freeze = 1;
+                break;
+            case 'u':
+                flags->is_unverified = 1;
+                break;
+            case 'p':
+                // Each -p names a hot function, the first one is the hottest
+                if (flags->hot_function_count < sizeof(flags->hot_functions) / sizeof(flags->hot_functions[0])) {
+                    swamp_unpack_profile_entry* entry = &flags->hot_functions[flags->hot_function_count];
+                    entry->function_name = optarg;
+                    entry->function_index = 0;
+                    entry->call_count = (uint32_t) (16 - flags->hot_function_count);
+                    flags->hot_function_count++;
+                }
+                break;
             default:
-                SWAMP_LOG_INFO("Usage: %s file -v", argv[0]);
+                SWAMP_LOG_INFO("Usage: %s file -v -l -c -e -f -u -p hot_function", argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
@@ -47,6 +85,44 @@ static void parse(options* flags, int argc, char* argv[])
     flags->pack_filename = argv[optind];
 }
 
+static uint32_t crc32c_bitwise(const uint8_t* octets, size_t octet_count)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < octet_count; ++i) {
+        crc ^= octets[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+// Known answers for the hashes. The 16 KiB input is long enough for the interleaved crc32 streams.
+static int check_hashes(void)
+{
+    static uint8_t pattern[16384];
+    for (size_t i = 0; i < sizeof(pattern); ++i) {
+        pattern[i] = (uint8_t) (i * 31);
+    }
+    const uint8_t* digits = (const uint8_t*) "123456789";
+
+    int failures = 0;
+    failures += swamp_unpack_crc32c(0, digits, 9) != 0xE3069283;
+    failures += swamp_unpack_crc32c(0, pattern, sizeof(pattern)) != 0x56E3FAA2;
+    failures += swamp_unpack_crc32c(0, pattern + 3, sizeof(pattern) - 3) !=
+                crc32c_bitwise(pattern + 3, sizeof(pattern) - 3);
+    failures += swamp_unpack_crc32c(swamp_unpack_crc32c(0, pattern, 5000), pattern + 5000, sizeof(pattern) - 5000) !=
+                0x56E3FAA2;
+    failures += swamp_unpack_xxh64(digits, 0, 0) != 0xEF46DB3751D8E999ull;
+    failures += swamp_unpack_xxh64(digits, 9, 0) != 0x8CB841DB40E6AE83ull;
+    failures += swamp_unpack_xxh64(pattern, sizeof(pattern), 0) != 0x8851D526965D9B65ull;
+
+    SWAMP_LOG_INFO("hash checks: %d failed", failures);
+
+    return failures;
+}
+
 int main(int argc, char* argv[])
 {
     g_clog.log = tyran_log_implementation;
@@ -55,6 +131,10 @@ int main(int argc, char* argv[])
     SWAMP_LOG_INFO("swamp-run 0.1.2");
     parse(&flags, argc, argv);
 
+    if (flags.is_check) {
+        return check_hashes() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     swamp_allocator allocator;
     swamp_allocator_init(&allocator);
     unpack_constants constants;
@@ -63,11 +143,37 @@ int main(int argc, char* argv[])
     swamp_unpack unpacker;
 
     swamp_unpack_init(&unpacker, &allocator, &constants, swamp_core_find_function, flags.is_verbose);
+    swamp_unpack_profile profile;
+    if (flags.hot_function_count > 0) {
+        profile.entries = flags.hot_functions;
+        profile.entry_count = flags.hot_function_count;
+        unpacker.profile = &profile;
+    }
+    // Checksum chunks are verified unless -u is given
+    unpacker.verify_checksums = !flags.is_unverified;
     // HACK!
     unpacker.ignore_external_function_bind_errors = flags.is_list;
-    int err = swamp_unpack_filename(&unpacker, flags.pack_filename, flags.is_verbose);
+    int err;
+    if (flags.is_embedded) {
+        err = swamp_unpack_embedded(&unpacker, swamp_unpack_example_pack, swamp_unpack_example_pack_octet_count,
+                                    flags.is_verbose);
+    } else {
+        err = swamp_unpack_filename(&unpacker, flags.pack_filename, flags.is_verbose);
+    }
     if (err != 0) {
         SWAMP_ERROR("problem:%d", err);
+    } else {
+        SWAMP_LOG_INFO("content hash %016llX", (unsigned long long) swamp_unpack_content_hash(&unpacker));
+    }
+    if (err == 0 && flags.is_freeze) {
+        int freezeErr = swamp_unpack_freeze(&unpacker, SWAMP_UNPACK_PROTECT_BODIES);
+        if (freezeErr != 0) {
+            SWAMP_ERROR("could not freeze:%d", freezeErr);
+        }
+        SWAMP_LOG_INFO("frozen into %zu octets", unpacker.frozen_region_octet_count);
+    }
+    if (unpacker.hot_region != 0) {
+        SWAMP_LOG_INFO("hot functions in %zu octets", unpacker.hot_region_octet_count);
     }
     const swamp_func* main_func = swamp_unpack_entry_point(&unpacker);
     if (main_func) {
@@ -0,0 +1,15 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef swamp_unpack_crc32c_h
+#define swamp_unpack_crc32c_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Continues a CRC32C (Castagnoli) checksum. Start with crc set to zero. Uses the SSE4.2 or ARMv8 crc32
+// instructions when the CPU supports them.
+uint32_t swamp_unpack_crc32c(uint32_t crc, const uint8_t* octets, size_t octet_count);
+
+#endif
@@ -8,6 +8,17 @@
 #include <swamp-runtime/types.h>
 #include <swamp-typeinfo/chunk.h>
 
+// Reference count given to every object owned by a frozen pack. It is far away from zero in both directions, so
+// no amount of INC_REF / DEC_REF traffic will ever release the object. It does not stop the writes themselves, a
+// runtime has to check SWAMP_UNPACK_IS_IMMORTAL() and skip them for that. The check is a threshold, so it still
+// holds for a count that a runtime without that check has moved up or down.
+#define SWAMP_UNPACK_IMMORTAL_REF_COUNT (0x40000000)
+#define SWAMP_UNPACK_IS_IMMORTAL(value)                                                                               \
+    (((const swamp_value*) (value))->internal.ref_count >= SWAMP_UNPACK_IMMORTAL_REF_COUNT / 2)
+
+// Flags for swamp_unpack_freeze()
+#define SWAMP_UNPACK_PROTECT_BODIES (1)
+
 struct unpack_constants;
 struct swamp_allocator;
 struct swamp_value;
@@ -22,14 +33,41 @@ void octet_stream_init(octet_stream* self, const uint8_t* octets, size_t octet_c
 
 typedef swamp_external_fn (*unpack_bind_fn)(const char* function_name);
 
+typedef struct swamp_unpack_profile_entry {
+    const char* function_name; // if zero, function_index is used instead
+    uint32_t function_index;
+    uint32_t call_count;
+} swamp_unpack_profile_entry;
+
+// Call counts recorded from earlier runs. Functions with a call count are placed together, hottest first. An entry
+// for the function name wins over one for its index, and the first of several entries for the same function wins.
+typedef struct swamp_unpack_profile {
+    const swamp_unpack_profile_entry* entries;
+    size_t entry_count;
+} swamp_unpack_profile;
+
 typedef struct swamp_unpack {
     struct swamp_allocator* allocator;
     struct unpack_constants* table;
     struct swamp_func* entry;
     unpack_bind_fn bind_fn;
+    const swamp_unpack_profile* profile;
+    uint8_t* hot_region;
+    size_t hot_region_octet_count;
+    size_t hot_region_body_offset;
+    uint8_t* frozen_region;
+    size_t frozen_region_octet_count;
+    size_t frozen_region_body_offset;
+    int is_frozen;
+    const uint8_t* static_octets;
+    size_t static_octet_count;
     int verbose_flag;
     int ignore_external_function_bind_errors;
     int offset_function_declarations;
+    // On by default. Chunks followed by a checksum chunk are rejected on mismatch. A pack without checksum chunks is
+    // accepted unverified.
+    int verify_checksums;
+    uint64_t content_hash; // XXH64 of the whole pack, for use as a cache or dedup key
     uint32_t function_declaration_count;
     SwtiChunk typeInfoChunk;
 } swamp_unpack;
@@ -47,7 +85,25 @@ void swamp_unpack_init(swamp_unpack* self, struct swamp_allocator* allocator, st
                        unpack_bind_fn bind_fn, int verbose_flag);
 int swamp_unpack_filename(swamp_unpack* self, const char* pack_filename, int verboseFlag);
 
+// Declares a pack embedded with swamp_unpack_embed_pack() in CMake.
+#define SWAMP_UNPACK_DECLARE_EMBEDDED_PACK(symbol)                                                                    \
+    extern const uint8_t symbol[];                                                                                     \
+    extern const size_t symbol##_octet_count
+
+// Unpacks a pack that stays mapped for the lifetime of the program, e.g. one embedded in the executable. The pack
+// is neither read nor copied as a whole. Each function's opcodes are copied by swamp_allocator_set_function(), unless
+// the runtime provides swamp_allocator_borrow_function(), then they point straight into the octets.
+int swamp_unpack_embedded(swamp_unpack* self, const uint8_t* octets, size_t octet_count, int verboseFlag);
+
 int swamp_unpack_octet_stream(swamp_unpack* self, octet_stream* s, int verboseFlag);
+
+// Call after unpacking and before forking. Moves every object the pack owns into one page aligned region and
+// makes it immortal, with the opcodes and constant tables on pages of their own. The runtime's reference counting
+// still writes to the object pages, so only those get copied by a worker, the body pages stay shared.
+// SWAMP_UNPACK_PROTECT_BODIES makes the bodies read-only. The object pages stay writable until the runtime skips
+// reference counting for SWAMP_UNPACK_IS_IMMORTAL() objects. Calling it again only retries the protection.
+int swamp_unpack_freeze(swamp_unpack* self, int protect_flags);
 struct swamp_func* swamp_unpack_entry_point(swamp_unpack* self);
+uint64_t swamp_unpack_content_hash(const swamp_unpack* self);
 
 #endif
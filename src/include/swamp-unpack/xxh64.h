@@ -0,0 +1,15 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef swamp_unpack_xxh64_h
+#define swamp_unpack_xxh64_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64-bit xxHash (XXH64) of the octets. Fast and well distributed, suitable as a cache or dedup key, but not
+// cryptographic, so it should not be trusted against deliberately crafted collisions.
+uint64_t swamp_unpack_xxh64(const uint8_t* octets, size_t octet_count, uint64_t seed);
+
+#endif
@@ -0,0 +1,86 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+#endif
+
+#include "pages.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <stdlib.h> // posix_memalign
+#include <sys/mman.h> // mprotect
+#include <unistd.h> // sysconf
+
+size_t swamp_unpack_page_size(void)
+{
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+void* swamp_unpack_pages_alloc(size_t octet_count)
+{
+    void* pages;
+    if (posix_memalign(&pages, swamp_unpack_page_size(), octet_count) != 0) {
+        return 0;
+    }
+
+    return pages;
+}
+
+int swamp_unpack_pages_protect(void* pages, size_t octet_count)
+{
+    return mprotect(pages, octet_count, PROT_READ) == 0 ? 0 : -1;
+}
+
+#elif defined(_WIN32)
+#include <windows.h>
+
+size_t swamp_unpack_page_size(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t) info.dwPageSize;
+}
+
+void* swamp_unpack_pages_alloc(size_t octet_count)
+{
+    return VirtualAlloc(0, octet_count, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+int swamp_unpack_pages_protect(void* pages, size_t octet_count)
+{
+    DWORD previous;
+    return VirtualProtect(pages, octet_count, PAGE_READONLY, &previous) ? 0 : -1;
+}
+
+#else
+#include <stdint.h>
+#include <stdlib.h> // malloc
+
+// No virtual memory to speak of. The layout is kept, but nothing can be protected.
+#define SWAMP_UNPACK_PAGE_SIZE (4096)
+
+size_t swamp_unpack_page_size(void)
+{
+    return SWAMP_UNPACK_PAGE_SIZE;
+}
+
+void* swamp_unpack_pages_alloc(size_t octet_count)
+{
+    uint8_t* octets = malloc(octet_count + SWAMP_UNPACK_PAGE_SIZE);
+    if (octets == 0) {
+        return 0;
+    }
+
+    return octets + SWAMP_UNPACK_PAGE_SIZE - ((uintptr_t) octets & (SWAMP_UNPACK_PAGE_SIZE - 1));
+}
+
+int swamp_unpack_pages_protect(void* pages, size_t octet_count)
+{
+    (void) pages;
+    (void) octet_count;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,21 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef swamp_unpack_pages_h
+#define swamp_unpack_pages_h
+
+#include <stddef.h>
+
+// The few operations on whole pages the hot and frozen regions need. Only those two features touch the platform,
+// plain unpacking builds anywhere.
+
+size_t swamp_unpack_page_size(void);
+
+// Returns page aligned memory, or zero. The regions live for the rest of the program, so there is no release.
+void* swamp_unpack_pages_alloc(size_t octet_count);
+
+// Makes whole pages read-only. Returns a negative value where that is not supported.
+int swamp_unpack_pages_protect(void* pages, size_t octet_count);
+
+#endif
@@ -15,9 +15,15 @@
 #include <raff/raff.h>
 #include <raff/tag.h>
 
+#include <stddef.h> // offsetof
+#include <stdlib.h> // qsort
 #include <string.h> // strcmp
+#include <swamp-unpack/crc32c.h>
+#include <swamp-unpack/xxh64.h>
 #include <swamp-unpack/swamp_unpack.h>
 
+#include "pages.h"
+
 void unpack_constants_init(unpack_constants* self)
 {
     self->index = 0;
@@ -197,6 +203,230 @@ static char* duplicate_string(const char* source)
     return target;
 }
 
+typedef struct hot_function {
+    uint32_t index;
+    uint32_t call_count;
+    uint8_t constant_count;
+    uint16_t opcode_count;
+    size_t constants_offset;
+    size_t opcodes_offset;
+} hot_function;
+
+// The profile entries sorted once, named entries by name first and then the rest by index, so every function is
+// looked up with a binary search instead of a scan of the whole profile.
+typedef struct profile_lookup {
+    const swamp_unpack_profile_entry** entries;
+    size_t named_count;
+    size_t entry_count;
+} profile_lookup;
+
+static int compare_profile_entries(const void* a, const void* b)
+{
+    const swamp_unpack_profile_entry* first = *(const swamp_unpack_profile_entry* const*) a;
+    const swamp_unpack_profile_entry* second = *(const swamp_unpack_profile_entry* const*) b;
+
+    if ((first->function_name != 0) != (second->function_name != 0)) {
+        return first->function_name != 0 ? -1 : 1;
+    }
+
+    if (first->function_name != 0) {
+        int difference = strcmp(first->function_name, second->function_name);
+        if (difference != 0) {
+            return difference;
+        }
+    } else if (first->function_index != second->function_index) {
+        return first->function_index < second->function_index ? -1 : 1;
+    }
+
+    // Duplicates keep the order of the profile, so the first one listed wins.
+    return first < second ? -1 : (first > second);
+}
+
+static int profile_lookup_init(profile_lookup* self, const swamp_unpack_profile* profile)
+{
+    self->entries = malloc(profile->entry_count * sizeof(swamp_unpack_profile_entry*));
+    if (self->entries == 0) {
+        return -1;
+    }
+
+    self->named_count = 0;
+    self->entry_count = profile->entry_count;
+    for (size_t i = 0; i < profile->entry_count; ++i) {
+        self->entries[i] = &profile->entries[i];
+        self->named_count += profile->entries[i].function_name != 0;
+    }
+
+    qsort(self->entries, self->entry_count, sizeof(swamp_unpack_profile_entry*), compare_profile_entries);
+
+    return 0;
+}
+
+// A function listed by name takes precedence over an entry for its index.
+static uint32_t profile_call_count(const profile_lookup* self, uint32_t index, const char* name)
+{
+    size_t low = 0;
+    size_t high = self->named_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (strcmp(self->entries[middle]->function_name, name) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < self->named_count && strcmp(self->entries[low]->function_name, name) == 0) {
+        return self->entries[low]->call_count;
+    }
+
+    low = self->named_count;
+    high = self->entry_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (self->entries[middle]->function_index < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < self->entry_count && self->entries[low]->function_index == index) {
+        return self->entries[low]->call_count;
+    }
+
+    return 0;
+}
+
+static int compare_hot_functions(const void* a, const void* b)
+{
+    const hot_function* first = (const hot_function*) a;
+    const hot_function* second = (const hot_function*) b;
+
+    if (first->call_count != second->call_count) {
+        return first->call_count > second->call_count ? -1 : 1;
+    }
+
+    return first->index < second->index ? -1 : 1;
+}
+
+static size_t align_offset(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static int is_in_region(const void* p, const uint8_t* region, size_t region_octet_count)
+{
+    const uint8_t* octet = (const uint8_t*) p;
+    return region != 0 && octet >= region && octet < region + region_octet_count;
+}
+
+// Moves a function body buffer into the hot or frozen region. swamp_allocator_set_function() allocates the constants
+// and opcodes with malloc and hands them to the swamp_func, so the copy replaces them and they are released here.
+static void* move_function_body(uint8_t* target, const void* source, size_t octet_count)
+{
+    if (octet_count > 0) {
+        memcpy(target, source, octet_count);
+    }
+    free((void*) source);
+
+    return target;
+}
+
+// Moves the swamp_func structs of the profiled functions into one page aligned region and reserves room directly
+// after them for their constants and opcodes. Only the constant table and the entry point refer to the structs
+// at this stage, so the original allocations can be released. Returns the number of hot functions.
+static uint32_t layout_hot_functions(swamp_unpack* self, const octet_stream* s, unpack_constants* repo,
+                                     uint32_t count, hot_function* hot_functions, int32_t* hot_slots)
+{
+    uint32_t hot_count = 0;
+
+    profile_lookup lookup;
+    if (profile_lookup_init(&lookup, self->profile) < 0) {
+        CLOG_SOFT_ERROR("could not allocate the profile lookup");
+        return 0;
+    }
+
+    octet_stream scan = *s;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t declarationRef = self->offset_function_declarations + i;
+        const swamp_func* func = (const swamp_func*) repo->table[declarationRef];
+
+        scan.position += 3;
+        uint8_t constant_count = read_uint8(&scan);
+        scan.position += constant_count * 2;
+        uint16_t opcode_count = read_uint16(&scan);
+        scan.position += opcode_count;
+
+        hot_slots[i] = -1;
+        uint32_t call_count = profile_call_count(&lookup, i, func->debug_name);
+        if (call_count == 0) {
+            continue;
+        }
+
+        hot_function* hot = &hot_functions[hot_count++];
+        hot->index = i;
+        hot->call_count = call_count;
+        hot->constant_count = constant_count;
+        hot->opcode_count = opcode_count;
+    }
+
+    free(lookup.entries);
+
+    if (hot_count == 0) {
+        return 0;
+    }
+
+    qsort(hot_functions, hot_count, sizeof(hot_function), compare_hot_functions);
+
+    // The bodies start on their own page, so they can be write protected when the pack is frozen.
+    size_t page_size = swamp_unpack_page_size();
+    size_t body_offset = align_offset(hot_count * sizeof(swamp_func), page_size);
+    size_t offset = body_offset;
+    for (uint32_t i = 0; i < hot_count; ++i) {
+        hot_function* hot = &hot_functions[i];
+        offset = align_offset(offset, sizeof(swamp_value*));
+        hot->constants_offset = offset;
+        offset += hot->constant_count * sizeof(swamp_value*);
+        hot->opcodes_offset = offset;
+        offset += hot->opcode_count;
+    }
+
+    size_t region_octet_count = align_offset(offset, page_size);
+    void* region = swamp_unpack_pages_alloc(region_octet_count);
+    if (region == 0) {
+        CLOG_SOFT_ERROR("could not allocate %zu octets for hot functions", region_octet_count);
+        return 0;
+    }
+
+    swamp_func* hot_structs = (swamp_func*) region;
+    for (uint32_t i = 0; i < hot_count; ++i) {
+        uint16_t declarationRef = self->offset_function_declarations + hot_functions[i].index;
+        swamp_func* original = (swamp_func*) repo->table[declarationRef];
+        swamp_func* relocated = &hot_structs[i];
+        *relocated = *original;
+        // The region owns the struct, so the runtime must never release it.
+        INC_REF(relocated);
+        if (self->entry == original) {
+            self->entry = relocated;
+        }
+        repo->table[declarationRef] = (swamp_value*) relocated;
+        free(original);
+        hot_slots[hot_functions[i].index] = (int32_t) i;
+    }
+
+    self->hot_region = (uint8_t*) region;
+    self->hot_region_octet_count = region_octet_count;
+    self->hot_region_body_offset = body_offset;
+
+    if (self->verbose_flag) {
+        SWAMP_LOG_DEBUG("=== hot functions (%d) in %zu octets ===", hot_count, region_octet_count);
+        for (uint32_t i = 0; i < hot_count; ++i) {
+            SWAMP_LOG_DEBUG("%d: '%s' calls:%d", hot_functions[i].index, hot_structs[i].debug_name,
+                            hot_functions[i].call_count);
+        }
+    }
+
+    return hot_count;
+}
+
 static void read_functions(swamp_unpack* self, octet_stream* s, swamp_allocator* allocator, unpack_constants* repo)
 {
     uint32_t count = read_dword_count(s);
@@ -209,6 +439,20 @@ static void read_functions(swamp_unpack* self, octet_stream* s, swamp_allocator*
         SWAMP_LOG_DEBUG("=== functions (%d) ===", count);
     }
 
+    hot_function* hot_functions = 0;
+    int32_t* hot_slots = 0;
+    if (self->profile != 0 && self->profile->entry_count > 0 && count > 0) {
+        hot_functions = malloc(count * sizeof(hot_function));
+        hot_slots = malloc(count * sizeof(int32_t));
+        if (hot_functions == 0 || hot_slots == 0 ||
+            layout_hot_functions(self, s, repo, count, hot_functions, hot_slots) == 0) {
+            free(hot_functions);
+            free(hot_slots);
+            hot_functions = 0;
+            hot_slots = 0;
+        }
+    }
+
     for (uint32_t i = 0; i < count; ++i) {
         uint8_t param_count = read_uint8(s);
         uint8_t variable_count = read_uint8(s);
@@ -249,10 +493,37 @@ static void read_functions(swamp_unpack* self, octet_stream* s, swamp_allocator*
         const uint8_t* opcodes = &s->octets[s->position];
         s->position += opcode_count;
         const size_t constant_parameter_count = 0;
-        swamp_allocator_set_function(previously_allocated_function, opcodes, opcode_count, constant_parameter_count,
-                                     param_count, variable_count, constants, constant_count,
-                                     previously_allocated_function->debug_name);
+#if defined SWAMP_UNPACK_BORROW_OPCODES
+        if (self->static_octets == s->octets) {
+            // The pack outlives the program, so the opcodes are used where they are in read-only memory.
+            swamp_allocator_borrow_function(previously_allocated_function, opcodes, opcode_count,
+                                            constant_parameter_count, param_count, variable_count, constants,
+                                            constant_count, previously_allocated_function->debug_name);
+        } else
+#endif
+        {
+            swamp_allocator_set_function(previously_allocated_function, opcodes, opcode_count,
+                                         constant_parameter_count, param_count, variable_count, constants,
+                                         constant_count, previously_allocated_function->debug_name);
+        }
+
+        if (hot_slots != 0 && hot_slots[i] >= 0) {
+            const hot_function* hot = &hot_functions[hot_slots[i]];
+            swamp_func* func = previously_allocated_function;
+            func->constants = move_function_body(self->hot_region + hot->constants_offset, func->constants,
+                                                 constant_count * sizeof(swamp_value*));
+            uint8_t* hot_opcodes = self->hot_region + hot->opcodes_offset;
+            if (is_in_region(func->opcodes, self->static_octets, self->static_octet_count)) {
+                memcpy(hot_opcodes, func->opcodes, opcode_count);
+                func->opcodes = hot_opcodes;
+            } else {
+                func->opcodes = move_function_body(hot_opcodes, func->opcodes, opcode_count);
+            }
+        }
     }
+
+    free(hot_functions);
+    free(hot_slots);
 }
 
 static void read_type_ref(octet_stream* s, uint16_t* typeRef)
@@ -388,11 +659,91 @@ int readAndVerifyRaffChunkHeader(octet_stream* s, RaffTag icon, RaffTag name)
         return -3;
     }
 
+    if (chunkSize > s->octet_count - s->position - count) {
+        CLOG_SOFT_ERROR("chunk is truncated, expected %d octets but only %d left", chunkSize,
+                        (int) (s->octet_count - s->position - count));
+        return -4;
+    }
+
     s->position += count;
 
     return chunkSize;
 }
 
+// The optional checksum chunk directly follows the chunk it covers and holds the CRC32C of that chunk's payload.
+// Anything that is not a checksum chunk, including too few octets to hold a chunk header, means there is none.
+static int readOptionalChecksumChunk(const octet_stream* s, size_t position, uint32_t* checksum)
+{
+    RaffTag checksumPacketName = {'s', 'c', 'k', '0'};
+    RaffTag checksumPacketIcon = {0xF0, 0x9F, 0x94, 0x92};
+
+    if (position >= s->octet_count) {
+        return 0;
+    }
+
+    RaffTag foundIcon, foundName;
+    uint32_t chunkSize;
+    size_t octetsLeft = s->octet_count - position;
+
+    int count = raffReadChunkHeader(&s->octets[position], octetsLeft, foundIcon, foundName, &chunkSize);
+    if (count < 0 || !raffTagEqual(checksumPacketIcon, foundIcon) || !raffTagEqual(checksumPacketName, foundName)) {
+        return 0;
+    }
+
+    if (chunkSize != 4 || octetsLeft - count < 4) {
+        CLOG_SOFT_ERROR("checksum chunk is malformed");
+        return -5;
+    }
+
+    const uint8_t* p = &s->octets[position + count];
+    *checksum = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+
+    return count + 4;
+}
+
+static int verifyChunkChecksum(swamp_unpack* self, octet_stream* s, int upcomingOctetsInChunk, int verboseFlag)
+{
+    uint32_t expectedChecksum;
+
+    int count = readOptionalChecksumChunk(s, s->position + upcomingOctetsInChunk, &expectedChecksum);
+    if (count < 0) {
+        return count;
+    }
+
+    if (count == 0 || !self->verify_checksums) {
+        return 0;
+    }
+
+    uint32_t checksum = swamp_unpack_crc32c(0, &s->octets[s->position], upcomingOctetsInChunk);
+    if (checksum != expectedChecksum) {
+        CLOG_SOFT_ERROR("chunk checksum mismatch %08X vs %08X", checksum, expectedChecksum);
+        return -6;
+    }
+
+    if (verboseFlag) {
+        SWAMP_LOG_DEBUG("chunk checksum %08X verified", checksum);
+    }
+
+    return 0;
+}
+
+// Continues after the chunk that ends at chunkEnd, regardless of where its parser stopped, and its checksum chunk.
+static int skipChunkChecksum(octet_stream* s, size_t chunkEnd)
+{
+    uint32_t ignoredChecksum;
+
+    s->position = chunkEnd;
+
+    int count = readOptionalChecksumChunk(s, s->position, &ignoredChecksum);
+    if (count < 0) {
+        return count;
+    }
+
+    s->position += count;
+
+    return 0;
+}
+
 int readRaffMarker(octet_stream* s, RaffTag tag, int verboseLevel)
 {
     int count = raffReadMarker(&s->octets[s->position], s->octet_count - s->position, tag);
@@ -430,11 +781,22 @@ int readTypeInformation(swamp_unpack* self, octet_stream* s, int verboseFlag)
     RaffTag expectedPacketIcon = {0xF0, 0x9F, 0x93, 0x9C};
 
     int upcomingOctetsInChunk = readAndVerifyRaffChunkHeader(s, expectedPacketIcon, expectedPacketName);
-    if (upcomingOctetsInChunk <= 0) {
+    if (upcomingOctetsInChunk < 0) {
         return upcomingOctetsInChunk;
     }
 
-    int errorCode = swtiDeserialize(&s->octets[s->position], upcomingOctetsInChunk, &self->typeInfoChunk);
+    size_t chunkEnd = s->position + upcomingOctetsInChunk;
+
+    int errorCode = verifyChunkChecksum(self, s, upcomingOctetsInChunk, verboseFlag);
+    if (errorCode < 0) {
+        return errorCode;
+    }
+
+    if (upcomingOctetsInChunk == 0) {
+        return skipChunkChecksum(s, chunkEnd);
+    }
+
+    errorCode = swtiDeserialize(&s->octets[s->position], upcomingOctetsInChunk, &self->typeInfoChunk);
     if (errorCode < 0) {
         CLOG_SOFT_ERROR("swtiDeserialize: error %d", errorCode);
         return errorCode;
@@ -444,9 +806,7 @@ int readTypeInformation(swamp_unpack* self, octet_stream* s, int verboseFlag)
         swtiChunkDebugOutput(&self->typeInfoChunk, 0, "readTypeInformation");
     }
 
-    s->position += upcomingOctetsInChunk;
-
-    return 0;
+    return skipChunkChecksum(s, chunkEnd);
 }
 
 int readCode(swamp_unpack* self, octet_stream* s, int verboseFlag)
@@ -457,10 +817,20 @@ int readCode(swamp_unpack* self, octet_stream* s, int verboseFlag)
     RaffTag expectedPacketIcon = {0xF0, 0x9F, 0x92, 0xBB};
 
     int upcomingOctetsInChunk = readAndVerifyRaffChunkHeader(s, expectedPacketIcon, expectedPacketName);
-    if (upcomingOctetsInChunk <= 0) {
+    if (upcomingOctetsInChunk < 0) {
         return upcomingOctetsInChunk;
     }
 
+    size_t chunkEnd = s->position + upcomingOctetsInChunk;
+
+    if ((errorCode = verifyChunkChecksum(self, s, upcomingOctetsInChunk, verboseFlag)) != 0) {
+        return errorCode;
+    }
+
+    if (upcomingOctetsInChunk == 0) {
+        return skipChunkChecksum(s, chunkEnd);
+    }
+
     RaffTag externalMarker = {0xF0, 0x9F, 0x91, 0xBE};
     if ((errorCode = verifyMarker(s, externalMarker, verboseFlag)) != 0) {
         return errorCode;
@@ -509,11 +879,16 @@ int readCode(swamp_unpack* self, octet_stream* s, int verboseFlag)
         SWAMP_LOG_INFO("done!\n");
     }
 
-    return 0;
+    return skipChunkChecksum(s, chunkEnd);
 }
 
 int swamp_unpack_octet_stream(swamp_unpack* self, octet_stream* s, int verboseFlag)
 {
+    self->content_hash = swamp_unpack_xxh64(&s->octets[s->position], s->octet_count - s->position, 0);
+    if (verboseFlag) {
+        SWAMP_LOG_DEBUG("pack content hash %016llX", (unsigned long long) self->content_hash);
+    }
+
     int errorCode = readAndVerifyRaffHeader(s);
     if (errorCode != 0) {
         return errorCode;
@@ -581,8 +956,20 @@ void swamp_unpack_init(swamp_unpack* self, swamp_allocator* allocator, unpack_co
     self->table = table;
     self->entry = 0;
     self->bind_fn = bind_fn;
+    self->profile = 0;
+    self->hot_region = 0;
+    self->hot_region_octet_count = 0;
+    self->hot_region_body_offset = 0;
+    self->frozen_region = 0;
+    self->frozen_region_octet_count = 0;
+    self->frozen_region_body_offset = 0;
+    self->is_frozen = 0;
+    self->static_octets = 0;
+    self->static_octet_count = 0;
     self->verbose_flag = verbose_flag;
     self->ignore_external_function_bind_errors = 0;
+    self->verify_checksums = 1;
+    self->content_hash = 0;
 }
 
 int swamp_unpack_filename(swamp_unpack* self, const char* pack_filename, int verboseFlag)
@@ -595,7 +982,305 @@ int swamp_unpack_filename(swamp_unpack* self, const char* pack_filename, int ver
     return result;
 }
 
+static swamp_func* function_from_declaration(swamp_unpack* self, uint32_t index)
+{
+    return (swamp_func*) self->table->table[self->offset_function_declarations + index];
+}
+
+static size_t value_octet_count(const swamp_value* value)
+{
+    switch (value->internal.type) {
+        case swamp_type_function:
+            return sizeof(swamp_func);
+        case swamp_type_external_function:
+            return sizeof(swamp_external_func);
+        case swamp_type_integer:
+            return sizeof(swamp_int);
+        case swamp_type_boolean:
+            return sizeof(swamp_boolean);
+        case swamp_type_string:
+            return sizeof(swamp_string);
+        default:
+            return 0;
+    }
+}
+
+static int is_frozen_function(const swamp_unpack* self, const swamp_func* func)
+{
+    return !is_in_region(func, self->hot_region, self->hot_region_octet_count);
+}
+
+static size_t function_body_octet_count(const swamp_unpack* self, const swamp_func* func)
+{
+    size_t octet_count = func->constant_count * sizeof(swamp_value*);
+    if (!is_in_region(func->opcodes, self->static_octets, self->static_octet_count)) {
+        octet_count += func->opcode_count;
+    }
+
+    return octet_count;
+}
+
+// C99 has no _Static_assert, a negative array size stops the build instead.
+#define SWAMP_UNPACK_STATIC_ASSERT(condition, name) typedef char swamp_unpack_static_assert_##name[(condition) ? 1 : -1]
+
+// Freezing writes SWAMP_UNPACK_IMMORTAL_REF_COUNT into the reference count and copies values by their header, so
+// every value must start with its internal header.
+SWAMP_UNPACK_STATIC_ASSERT(sizeof(((swamp_value*) 0)->internal.ref_count) >= sizeof(int32_t), ref_count_width);
+SWAMP_UNPACK_STATIC_ASSERT(offsetof(swamp_func, internal) == 0, func_header);
+SWAMP_UNPACK_STATIC_ASSERT(offsetof(swamp_external_func, internal) == 0, external_func_header);
+SWAMP_UNPACK_STATIC_ASSERT(offsetof(swamp_int, internal) == 0, int_header);
+SWAMP_UNPACK_STATIC_ASSERT(offsetof(swamp_boolean, internal) == 0, boolean_header);
+SWAMP_UNPACK_STATIC_ASSERT(offsetof(swamp_string, internal) == 0, string_header);
+
+typedef struct frozen_value {
+    const swamp_value* original;
+    swamp_value* frozen;
+    size_t offset;
+    int table_index;
+} frozen_value;
+
+static int compare_frozen_originals(const void* a, const void* b)
+{
+    const frozen_value* first = (const frozen_value*) a;
+    const frozen_value* second = (const frozen_value*) b;
+
+    if (first->original != second->original) {
+        return first->original < second->original ? -1 : 1;
+    }
+
+    return first->table_index - second->table_index;
+}
+
+static int compare_frozen_table_indices(const void* a, const void* b)
+{
+    return ((const frozen_value*) a)->table_index - ((const frozen_value*) b)->table_index;
+}
+
+// The values must be sorted by original.
+static swamp_value* lookup_frozen_value(const frozen_value* values, size_t count, const swamp_value* original)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (values[middle].original < original) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < count && values[low].original == original) {
+        return values[low].frozen;
+    }
+
+    return (swamp_value*) original;
+}
+
+// Lays out the frozen region as the object headers followed, on their own pages, by the function bodies. Hot
+// functions keep their headers and bodies in the hot region.
+//
+// Ownership: the function declarations were allocated by read_function_declarations() and belong to the unpacker,
+// so the originals are released once copied, together with their bodies. Every other value belongs to the
+// allocator and can be referenced from it, so only its header is copied and the original is left alone. Out of
+// line data, such as the characters of a string, is shared by both. That keeps one header per value twice, a few
+// octets each.
+static int freeze_objects_and_bodies(swamp_unpack* self, size_t page_size)
+{
+    unpack_constants* repo = self->table;
+    const size_t object_alignment = 2 * sizeof(void*);
+
+    for (uint32_t i = 0; i < self->function_declaration_count; ++i) {
+        const swamp_func* func = function_from_declaration(self, i);
+        if (func->internal.type != swamp_type_function) {
+            CLOG_SOFT_ERROR("function declaration %d has type %d", i, func->internal.type);
+            return -1;
+        }
+    }
+
+    frozen_value* values = malloc(repo->index * sizeof(frozen_value));
+    if (values == 0 && repo->index > 0) {
+        CLOG_SOFT_ERROR("could not allocate the frozen value map");
+        return -1;
+    }
+
+    size_t value_count = 0;
+    for (int i = 0; i < repo->index; ++i) {
+        const swamp_value* value = repo->table[i];
+        if (is_in_region(value, self->hot_region, self->hot_region_octet_count)) {
+            continue;
+        }
+        frozen_value* entry = &values[value_count++];
+        entry->original = value;
+        entry->frozen = (swamp_value*) value;
+        entry->table_index = i;
+    }
+
+    // The same value can be in the table more than once, the first entry keeps it.
+    qsort(values, value_count, sizeof(frozen_value), compare_frozen_originals);
+    size_t unique_count = 0;
+    const swamp_value* previous = 0;
+    for (size_t i = 0; i < value_count; ++i) {
+        if (values[i].original == previous) {
+            continue;
+        }
+        previous = values[i].original;
+        if (value_octet_count(values[i].original) == 0) {
+            CLOG_SOFT_ERROR("can not freeze value of type %d, it stays in place", values[i].original->internal.type);
+            continue;
+        }
+        values[unique_count++] = values[i];
+    }
+
+    // Objects are laid out in table order, which is roughly the order the code refers to them.
+    qsort(values, unique_count, sizeof(frozen_value), compare_frozen_table_indices);
+    size_t offset = 0;
+    for (size_t i = 0; i < unique_count; ++i) {
+        offset = align_offset(offset, object_alignment);
+        values[i].offset = offset;
+        offset += value_octet_count(values[i].original);
+    }
+
+    size_t body_offset = align_offset(offset, page_size);
+    offset = body_offset;
+    for (uint32_t i = 0; i < self->function_declaration_count; ++i) {
+        const swamp_func* func = function_from_declaration(self, i);
+        if (is_frozen_function(self, func)) {
+            offset = align_offset(offset, sizeof(swamp_value*));
+            offset += function_body_octet_count(self, func);
+        }
+    }
+
+    size_t region_octet_count = align_offset(offset, page_size);
+    void* region = 0;
+    if (region_octet_count > 0 && (region = swamp_unpack_pages_alloc(region_octet_count)) == 0) {
+        CLOG_SOFT_ERROR("could not allocate %zu octets for the frozen pack", region_octet_count);
+        free(values);
+        return -1;
+    }
+    uint8_t* octets = (uint8_t*) region;
+
+    for (size_t i = 0; i < unique_count; ++i) {
+        values[i].frozen = (swamp_value*) (octets + values[i].offset);
+        memcpy(values[i].frozen, values[i].original, value_octet_count(values[i].original));
+    }
+
+    qsort(values, unique_count, sizeof(frozen_value), compare_frozen_originals);
+
+    for (int i = 0; i < repo->index; ++i) {
+        swamp_value* value = lookup_frozen_value(values, unique_count, repo->table[i]);
+        value->internal.ref_count = SWAMP_UNPACK_IMMORTAL_REF_COUNT;
+        repo->table[i] = value;
+    }
+    if (self->entry != 0) {
+        self->entry = (swamp_func*) lookup_frozen_value(values, unique_count, (const swamp_value*) self->entry);
+    }
+
+    for (uint32_t i = 0; i < self->function_declaration_count; ++i) {
+        swamp_func* func = function_from_declaration(self, i);
+        for (size_t j = 0; j < func->constant_count; ++j) {
+            func->constants[j] = lookup_frozen_value(values, unique_count, func->constants[j]);
+        }
+    }
+
+    for (size_t i = 0; i < unique_count; ++i) {
+        if (values[i].original->internal.type == swamp_type_function) {
+            free((void*) values[i].original);
+        }
+    }
+
+    free(values);
+
+    offset = body_offset;
+    for (uint32_t i = 0; i < self->function_declaration_count; ++i) {
+        swamp_func* func = function_from_declaration(self, i);
+        if (!is_frozen_function(self, func)) {
+            continue;
+        }
+
+        offset = align_offset(offset, sizeof(swamp_value*));
+        size_t constants_octet_count = func->constant_count * sizeof(swamp_value*);
+        func->constants = move_function_body(octets + offset, func->constants, constants_octet_count);
+        offset += constants_octet_count;
+
+        if (is_in_region(func->opcodes, self->static_octets, self->static_octet_count)) {
+            continue;
+        }
+
+        func->opcodes = move_function_body(octets + offset, func->opcodes, func->opcode_count);
+        offset += func->opcode_count;
+    }
+
+    self->frozen_region = octets;
+    self->frozen_region_octet_count = region_octet_count;
+    self->frozen_region_body_offset = body_offset;
+
+    return 0;
+}
+
+static int protect_octets(uint8_t* octets, size_t octet_count, const char* description)
+{
+    if (octet_count == 0) {
+        return 0;
+    }
+
+    if (swamp_unpack_pages_protect(octets, octet_count) != 0) {
+        CLOG_SOFT_ERROR("could not protect %s", description);
+        return -2;
+    }
+
+    return 0;
+}
+
+int swamp_unpack_freeze(swamp_unpack* self, int protect_flags)
+{
+    int errorCode;
+
+    // Once the pack has moved, calling again only retries the protection.
+    if (!self->is_frozen) {
+        if ((errorCode = freeze_objects_and_bodies(self, swamp_unpack_page_size())) < 0) {
+            return errorCode;
+        }
+        self->is_frozen = 1;
+
+        if (self->verbose_flag) {
+            SWAMP_LOG_DEBUG("froze %d values into %zu octets of objects and %zu octets of function bodies",
+                            self->table->index, self->frozen_region_body_offset,
+                            self->frozen_region_octet_count - self->frozen_region_body_offset);
+        }
+    }
+
+    if (protect_flags & SWAMP_UNPACK_PROTECT_BODIES) {
+        if ((errorCode = protect_octets(self->frozen_region + self->frozen_region_body_offset,
+                                        self->frozen_region_octet_count - self->frozen_region_body_offset,
+                                        "frozen function bodies")) != 0) {
+            return errorCode;
+        }
+        if ((errorCode = protect_octets(self->hot_region + self->hot_region_body_offset,
+                                        self->hot_region_octet_count - self->hot_region_body_offset,
+                                        "hot function bodies")) != 0) {
+            return errorCode;
+        }
+    }
+
+    return 0;
+}
+
+int swamp_unpack_embedded(swamp_unpack* self, const uint8_t* octets, size_t octet_count, int verboseFlag)
+{
+    octet_stream stream;
+    octet_stream_init(&stream, octets, octet_count);
+    self->static_octets = octets;
+    self->static_octet_count = octet_count;
+    return swamp_unpack_octet_stream(self, &stream, verboseFlag);
+}
+
 struct swamp_func* swamp_unpack_entry_point(swamp_unpack* self)
 {
     return self->entry;
 }
+
+uint64_t swamp_unpack_content_hash(const swamp_unpack* self)
+{
+    return self->content_hash;
+}
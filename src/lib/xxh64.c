@@ -0,0 +1,108 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <swamp-unpack/xxh64.h>
+
+#include <string.h> // memcpy
+
+
+#define SWAMP_UNPACK_XXH64_PRIME1 (0x9E3779B185EBCA87ull)
+#define SWAMP_UNPACK_XXH64_PRIME2 (0xC2B2AE3D27D4EB4Full)
+#define SWAMP_UNPACK_XXH64_PRIME3 (0x165667B19E3779F9ull)
+#define SWAMP_UNPACK_XXH64_PRIME4 (0x85EBCA77C2B2AE63ull)
+#define SWAMP_UNPACK_XXH64_PRIME5 (0x27D4EB2F165667C5ull)
+
+static inline uint64_t rotate_left(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read_little_endian_uint64(const uint8_t* p)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+#else
+    return (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24) |
+           ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40) | ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+#endif
+}
+
+static inline uint32_t read_little_endian_uint32(const uint8_t* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t round_lane(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * SWAMP_UNPACK_XXH64_PRIME2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * SWAMP_UNPACK_XXH64_PRIME1;
+}
+
+static inline uint64_t merge_lane(uint64_t hash, uint64_t lane)
+{
+    hash ^= round_lane(0, lane);
+    return hash * SWAMP_UNPACK_XXH64_PRIME1 + SWAMP_UNPACK_XXH64_PRIME4;
+}
+
+uint64_t swamp_unpack_xxh64(const uint8_t* octets, size_t octet_count, uint64_t seed)
+{
+    const uint8_t* p = octets;
+    const uint8_t* end = octets + octet_count;
+    uint64_t hash;
+
+    if (octet_count >= 32) {
+        // Four independent lanes, so the multiplies of one lane overlap with the others.
+        uint64_t lane0 = seed + SWAMP_UNPACK_XXH64_PRIME1 + SWAMP_UNPACK_XXH64_PRIME2;
+        uint64_t lane1 = seed + SWAMP_UNPACK_XXH64_PRIME2;
+        uint64_t lane2 = seed;
+        uint64_t lane3 = seed - SWAMP_UNPACK_XXH64_PRIME1;
+
+        const uint8_t* limit = end - 32;
+        do {
+            lane0 = round_lane(lane0, read_little_endian_uint64(p));
+            lane1 = round_lane(lane1, read_little_endian_uint64(p + 8));
+            lane2 = round_lane(lane2, read_little_endian_uint64(p + 16));
+            lane3 = round_lane(lane3, read_little_endian_uint64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotate_left(lane0, 1) + rotate_left(lane1, 7) + rotate_left(lane2, 12) + rotate_left(lane3, 18);
+        hash = merge_lane(hash, lane0);
+        hash = merge_lane(hash, lane1);
+        hash = merge_lane(hash, lane2);
+        hash = merge_lane(hash, lane3);
+    } else {
+        hash = seed + SWAMP_UNPACK_XXH64_PRIME5;
+    }
+
+    hash += (uint64_t) octet_count;
+
+    while (p + 8 <= end) {
+        hash ^= round_lane(0, read_little_endian_uint64(p));
+        hash = rotate_left(hash, 27) * SWAMP_UNPACK_XXH64_PRIME1 + SWAMP_UNPACK_XXH64_PRIME4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        hash ^= (uint64_t) read_little_endian_uint32(p) * SWAMP_UNPACK_XXH64_PRIME1;
+        hash = rotate_left(hash, 23) * SWAMP_UNPACK_XXH64_PRIME2 + SWAMP_UNPACK_XXH64_PRIME3;
+        p += 4;
+    }
+
+    while (p < end) {
+        hash ^= (*p++) * SWAMP_UNPACK_XXH64_PRIME5;
+        hash = rotate_left(hash, 11) * SWAMP_UNPACK_XXH64_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= SWAMP_UNPACK_XXH64_PRIME2;
+    hash ^= hash >> 29;
+    hash *= SWAMP_UNPACK_XXH64_PRIME3;
+    hash ^= hash >> 32;
+
+    return hash;
+}